@@ -11,13 +11,14 @@
 #include <unordered_map>
 #include <limits>
 #include <fstream>
+#include <cstdlib>
 
 using namespace std;
 
 // Structure created to represent an entry in the Translation Lookaside Buffer (TLB)
 struct TLBEntry {
     int page_number;
-    int last_used; // when the TLB entry was last accessed (for policies like lru)
+    long long last_used; // when the TLB entry was last accessed (for policies like lru)
 };
 
 // Function to compare last used times
@@ -39,7 +40,7 @@ public:
         delete[] entries;
     }
 
-    bool find_entry(int page_number, int current_time) {
+    bool find_entry(int page_number, long long current_time) {
         // function to check if the entry being accessed is already present in the TLB 
         for (int i = 0; i < current_count; i++) {
             if (entries[i].page_number == page_number) {
@@ -50,7 +51,7 @@ public:
         return false;
     }
 
-    void insert_fifo(int page_number, int current_time) {
+    void insert_fifo(int page_number, long long current_time) {
         // the FIFO (First In First Out) property replaces the entry that was the earliest one to be accessed 
         // note that FIFO doesn't account for the recency of the entries 
         if (current_count >= size) {
@@ -62,7 +63,7 @@ public:
         entries[current_count++] = {page_number, current_time}; // new entry is added 
     }
 
-    void insert_lifo(int page_number, int current_time) {
+    void insert_lifo(int page_number, long long current_time) {
         // the LIFO (Last In First Out) essentially pops out the entry that came in last
         if (current_count >= size) {
             current_count = current_count-1; // move back by 1, so that the new entry replaces the last entry 
@@ -70,7 +71,7 @@ public:
         entries[current_count++] = {page_number, current_time}; // Update new entry
     }
 
-    void insert_optimal(int page_number, int current_time, const unsigned int* accesses, int current_index, int N) {
+    void insert_optimal(int page_number, long long current_time, const unsigned int* accesses, int current_index, int N) {
         // this is the most optimal policy in terms of the number of TLB hits
         // however, it is practically impossible to implement because it requires knowledge of future accesses 
         // it replaces the entry that will be replaced farthest in the future 
@@ -100,6 +101,37 @@ public:
         }
         entries[current_count++] = {page_number, current_time}; // Add new entry
     }
+
+    void insert_lookahead(int page_number, long long current_time, const unordered_map<int, deque<long long>>& next_uses) {
+        // OPT with a bounded view of the future, used by the streaming mode
+        // instead of searching the whole trace, the next use of a page is looked up in the
+        // occurrence lists of the lookahead window; a page that does not occur in the window is
+        // treated as never used again. With a window as long as the trace this is exactly OPT.
+        if (current_count >= size) {
+            long long farthest = -1;
+            int replace_index = 0;
+
+            for (int i = 0; i < current_count; i++) {
+                auto it = next_uses.find(entries[i].page_number);
+                if (it == next_uses.end()) {
+                    replace_index = i; // not used again within the window
+                    break;
+                }
+                long long dist = it->second.front(); // position of the next access
+                if (dist > farthest) {
+                    farthest = dist;
+                    replace_index = i;
+                }
+            }
+
+            // Shift entries to remove the farthest entry
+            for (int i = replace_index; i < current_count - 1; i++) {
+                entries[i] = entries[i + 1];
+            }
+            current_count--;
+        }
+        entries[current_count++] = {page_number, current_time}; // Add new entry
+    }
 };
 
 class TLB_lru {
@@ -117,7 +149,7 @@ public:
         delete[] entries;
     }
 
-    bool find_entry(int page_number, int current_time) {
+    bool find_entry(int page_number, long long current_time) {
         // Check if the page is in the TLB using the map
         if (page_map.find(page_number) != page_map.end()) {
             int index = page_map[page_number]; // Get the index of the entry
@@ -127,7 +159,7 @@ public:
         return false;
     }
 
-    void insert_lru(int page_number, int current_time) {
+    void insert_lru(int page_number, long long current_time) {
         // the LRU (Least Recently Used) policy 
         if (current_count >= size) {
             // Find the least recently used entry
@@ -157,7 +189,116 @@ public:
 };
 
 
-int main() {
+// prints the hit rate of every policy, both since the start and over the last interval
+void report_snapshot(long long accesses, const long long hits[4], const long long interval_hits[4], long long interval) {
+    cout << "accesses=" << accesses << fixed << setprecision(2);
+    const char* names[4] = {"fifo", "lifo", "lru", "opt-window"};
+    for (int p = 0; p < 4; p++) {
+        cout << " " << names[p] << "=" << 100.0 * hits[p] / accesses << "%"
+             << "(" << (interval ? 100.0 * interval_hits[p] / interval : 0.0) << "%)";
+    }
+    cout << defaultfloat << endl;
+}
+
+int run_streaming(long long window, long long report_every) {
+    // STREAMING MODE
+    // input: S P K on the first line, then hexadecimal addresses until the end of the input
+    // only the current access and 'window' future ones are buffered, so memory stays bounded no matter
+    // how long the trace is. Every 'report_every' accesses the hit rates so far are printed,
+    // the final line has the total hits in the same order as the batch mode.
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    int S, P, K;
+    if (!(cin >> S >> P >> K)) {
+        cerr << "Error reading S P K for the stream" << endl;
+        return 1;
+    }
+
+    TLB tlb_fifo(K);
+    TLB tlb_lifo(K);
+    TLB_lru tlb_lru(K);
+    TLB tlb_opt(K);
+
+    deque<int> lookahead;                            // page numbers of the accesses not processed yet
+    unordered_map<int, deque<long long>> next_uses;  // positions of each page within the lookahead
+    long long read_count = 0;                        // accesses read so far
+    long long processed = 0;                         // accesses simulated so far
+    long long hits[4] = {0, 0, 0, 0};                // fifo, lifo, lru, opt-window
+    long long interval_hits[4] = {0, 0, 0, 0};
+    bool input_done = false;
+
+    while (true) {
+        // top up the lookahead window: the access about to be processed plus 'window' future ones
+        while (!input_done && (long long)lookahead.size() < window + 1) {
+            unsigned int address;
+            if (!(cin >> hex >> address)) {
+                if (!cin.eof()) {
+                    cerr << "Error reading address " << read_count + 1 << " of the stream" << endl;
+                    return 1;
+                }
+                input_done = true;
+                break;
+            }
+            int page = address / (P * 1024);
+            lookahead.push_back(page);
+            next_uses[page].push_back(read_count++);
+        }
+        if (lookahead.empty()) {
+            break;
+        }
+
+        int page_number = lookahead.front();
+        long long i = processed;
+        lookahead.pop_front();
+        // this access is no longer in the future, drop it from the occurrence lists
+        auto occ = next_uses.find(page_number);
+        occ->second.pop_front();
+        if (occ->second.empty()) {
+            next_uses.erase(occ);
+        }
+
+        bool hit[4];
+        hit[0] = tlb_fifo.find_entry(page_number, i);
+        if (!hit[0]) tlb_fifo.insert_fifo(page_number, i);
+        hit[1] = tlb_lifo.find_entry(page_number, i);
+        if (!hit[1]) tlb_lifo.insert_lifo(page_number, i);
+        hit[2] = tlb_lru.find_entry(page_number, i);
+        if (!hit[2]) tlb_lru.insert_lru(page_number, i);
+        hit[3] = tlb_opt.find_entry(page_number, i);
+        if (!hit[3]) tlb_opt.insert_lookahead(page_number, i, next_uses);
+        for (int p = 0; p < 4; p++) {
+            hits[p] += hit[p];
+            interval_hits[p] += hit[p];
+        }
+
+        processed++;
+        if (report_every > 0 && processed % report_every == 0) {
+            report_snapshot(processed, hits, interval_hits, report_every);
+            fill(interval_hits, interval_hits + 4, 0);
+        }
+    }
+
+    if (processed > 0 && (report_every <= 0 || processed % report_every != 0)) {
+        report_snapshot(processed, hits, interval_hits, report_every > 0 ? processed % report_every : processed);
+    }
+    cout << hits[0] << " " << hits[1] << " " << hits[2] << " " << hits[3] << endl;
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    // "--stream [window] [report-every]" evaluates an unbounded trace with bounded memory
+    if (argc > 1 && string(argv[1]) == "--stream") {
+        long long window = argc > 2 ? atoll(argv[2]) : 4096;
+        long long report_every = argc > 3 ? atoll(argv[3]) : 1000000;
+        if (window < 1) {
+            cerr << "The lookahead window must hold at least one access" << endl;
+            return 1;
+        }
+        return run_streaming(window, report_every);
+    }
+
     int T;  // This is the number of test cases
     cin >> T;
 
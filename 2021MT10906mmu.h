@@ -7,6 +7,7 @@
 #include <string.h>
 #include <stdbool.h>  
 #include <stddef.h>    
+#include <stdint.h>
 
 
 #define align4(x) (((((x)-1) >> 2) << 2) + 4)
@@ -134,7 +135,358 @@ mem_ptr make_space(mem_ptr last, size_t size) {
     return block;
 }
 
+// HUGE PAGE ARENA
+// sbrk grows the heap a few bytes at a time, so the kernel never backs it with transparent huge
+// pages, and first fit scatters small blocks of different sizes over many 4K pages.
+// In arena mode small requests (up to ARENA_MAX_SIZE) are instead served from 2MB-aligned
+// regions obtained with mmap and marked with madvise(MADV_HUGEPAGE). Each region is cut into
+// 64KB runs and every run only holds objects of one size class, so objects of the same size
+// stay packed in the same pages. Because regions are 2MB-aligned, the region (and the run) an
+// object belongs to is found by masking its address, no per-object header is needed; my_free()
+// confirms the masked address is one of our regions with a binary search of a sorted table.
+// Regions are never unmapped, but a run whose last object is freed is given back to the kernel
+// with madvise(MADV_DONTNEED) and later reused by any size class, so the resident memory follows
+// the live objects rather than the peak. Releasing part of a region splits its huge page.
+
+#define ARENA_REGION_SIZE (2 * 1024 * 1024)
+#define ARENA_RUN_SIZE (64 * 1024)
+#define ARENA_RUNS (ARENA_REGION_SIZE / ARENA_RUN_SIZE)
+#define ARENA_PAGE_SIZE 4096
+#define ARENA_MIN_SHIFT 4                              // smallest class is 16 bytes
+#define ARENA_CLASSES 8                                // 16, 32, ..., 2048 bytes
+#define ARENA_MAX_SIZE ((size_t)1 << (ARENA_MIN_SHIFT + ARENA_CLASSES - 1))
+#define ARENA_NO_CLASS 0xFF
+#define ARENA_MAX_OBJECTS (ARENA_RUN_SIZE >> ARENA_MIN_SHIFT)  // objects in a run of the smallest class
+
+/* Metadata at the start of every region (run 0 starts after it) */
+struct arena_region {
+    struct arena_region *next;
+    size_t runs_used;                       // runs handed out so far
+    size_t runs_returned;                   // runs among those that were emptied and given back
+    unsigned char run_class[ARENA_RUNS];    // size class of each run (ARENA_NO_CLASS once given back)
+    size_t run_top[ARENA_RUNS];             // bytes of the run handed out so far (high water mark)
+    size_t run_live[ARENA_RUNS];            // live objects in the run
+    uint64_t run_in_use[ARENA_RUNS][ARENA_MAX_OBJECTS / 64];  // one bit per object slot, set while handed out
+};
+
+#define ARENA_HEADER_SPACE ((sizeof(struct arena_region) + ARENA_PAGE_SIZE - 1) & ~(size_t)(ARENA_PAGE_SIZE - 1))
+
+/* Per size class state */
+struct arena_class {
+    void *free_list;                 // freed objects of this class (next pointer stored in the object)
+    struct arena_region *region;     // region of the run currently being carved
+    size_t run;                      // index of that run
+    size_t live;                     // live objects of this class
+};
+
+bool arena_mode = false;
+struct arena_region *arena_regions = NULL;    // every region, newest first
+struct arena_region **arena_table = NULL;     // the same regions sorted by address, for lookups
+size_t arena_table_len = 0;
+size_t arena_table_cap = 0;
+size_t arena_runs_returned = 0;               // given-back runs waiting to be reused, in all regions
+struct arena_class arena_classes[ARENA_CLASSES];
+
+// turns the arena mode on or off (blocks already handed out keep being freed correctly)
+void mmu_use_arena(bool on) {
+    arena_mode = on;
+}
+
+int arena_class_of(size_t size) {
+    int c = 0;
+    while (((size_t)1 << (ARENA_MIN_SHIFT + c)) < size) {
+        c++;
+    }
+    return c;
+}
+
+size_t arena_class_size(int c) {
+    return (size_t)1 << (ARENA_MIN_SHIFT + c);
+}
+
+char *arena_run_start(struct arena_region *r, size_t run) {
+    return (char *)r + run * ARENA_RUN_SIZE + (run == 0 ? ARENA_HEADER_SPACE : 0);
+}
+
+size_t arena_run_capacity(size_t run) {
+    return ARENA_RUN_SIZE - (run == 0 ? ARENA_HEADER_SPACE : 0);
+}
+
+// inserts r into the sorted region table, growing it with mmap (sbrk belongs to the heap)
+bool arena_table_insert(struct arena_region *r) {
+    if (arena_table_len == arena_table_cap) {
+        size_t cap = arena_table_cap ? arena_table_cap * 2 : ARENA_PAGE_SIZE / sizeof(struct arena_region *);
+        struct arena_region **bigger = mmap(NULL, cap * sizeof(struct arena_region *), PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bigger == MAP_FAILED) {
+            return false;
+        }
+        if (arena_table) {
+            memcpy(bigger, arena_table, arena_table_len * sizeof(struct arena_region *));
+            munmap(arena_table, arena_table_cap * sizeof(struct arena_region *));
+        }
+        arena_table = bigger;
+        arena_table_cap = cap;
+    }
+    size_t i = arena_table_len;
+    while (i > 0 && arena_table[i - 1] > r) {
+        arena_table[i] = arena_table[i - 1];
+        i--;
+    }
+    arena_table[i] = r;
+    arena_table_len++;
+    return true;
+}
+
+// reserves a new 2MB-aligned region: map 4MB, then give back the unaligned head and tail
+struct arena_region *arena_new_region(void) {
+    size_t span = 2 * ARENA_REGION_SIZE;
+    char *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    char *aligned = (char *)(((size_t)raw + ARENA_REGION_SIZE - 1) & ~(size_t)(ARENA_REGION_SIZE - 1));
+    if (aligned > raw) {
+        munmap(raw, aligned - raw);
+    }
+    if (aligned + ARENA_REGION_SIZE < raw + span) {
+        munmap(aligned + ARENA_REGION_SIZE, (raw + span) - (aligned + ARENA_REGION_SIZE));
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, ARENA_REGION_SIZE, MADV_HUGEPAGE);  // ask for THP backing (best effort)
+#endif
+
+    struct arena_region *r = (struct arena_region *)aligned;
+    if (!arena_table_insert(r)) {
+        munmap(aligned, ARENA_REGION_SIZE);
+        return NULL;
+    }
+    r->runs_used = 0;
+    r->runs_returned = 0;
+    memset(r->run_class, ARENA_NO_CLASS, sizeof(r->run_class));
+    memset(r->run_top, 0, sizeof(r->run_top));
+    memset(r->run_live, 0, sizeof(r->run_live));
+    memset(r->run_in_use, 0, sizeof(r->run_in_use));
+    r->next = arena_regions;
+    arena_regions = r;
+    return r;
+}
+
+// finds a run that was given back, for reuse (only searched while there is one)
+bool arena_take_returned_run(struct arena_region **region, size_t *run) {
+    for (struct arena_region *r = arena_regions; r && arena_runs_returned > 0; r = r->next) {
+        if (r->runs_returned == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < r->runs_used; i++) {
+            if (r->run_class[i] == ARENA_NO_CLASS) {
+                r->runs_returned--;
+                arena_runs_returned--;
+                *region = r;
+                *run = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// hands a fresh run to size class c: a given-back run, else the next one of the newest region or a new region
+bool arena_new_run(int c) {
+    struct arena_region *r;
+    size_t run;
+    if (!arena_take_returned_run(&r, &run)) {
+        r = arena_regions;
+        if (!r || r->runs_used == ARENA_RUNS) {
+            r = arena_new_region();
+            if (!r) {
+                return false;
+            }
+        }
+        run = r->runs_used++;
+    }
+    r->run_class[run] = (unsigned char)c;
+    arena_classes[c].region = r;
+    arena_classes[c].run = run;
+    return true;
+}
+
+// returns the region containing p, or NULL if p was not handed out by the arena
+struct arena_region *arena_region_of(void *p) {
+    struct arena_region *r = (struct arena_region *)((size_t)p & ~(size_t)(ARENA_REGION_SIZE - 1));
+    size_t lo = 0, hi = arena_table_len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (arena_table[mid] == r) {
+            return r;
+        }
+        if (arena_table[mid] < r) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+// checks that p is the start of an object slot the arena has carved out of region r,
+// and if so returns its run and its slot index within the run
+bool arena_slot_of(struct arena_region *r, void *p, size_t *run, size_t *slot) {
+    if ((char *)p < (char *)r + ARENA_HEADER_SPACE) {
+        return false;  // points into the region header
+    }
+    size_t i = ((char *)p - (char *)r) / ARENA_RUN_SIZE;
+    if (i >= r->runs_used || r->run_class[i] == ARENA_NO_CLASS) {
+        return false;  // run was never handed out
+    }
+    size_t offset = (char *)p - arena_run_start(r, i);
+    size_t obj = arena_class_size(r->run_class[i]);
+    if (offset % obj != 0 || offset >= r->run_top[i]) {
+        return false;  // middle of an object, or the unused tail of the run
+    }
+    *run = i;
+    *slot = offset / obj;
+    return true;
+}
+
+bool arena_slot_in_use(struct arena_region *r, size_t run, size_t slot) {
+    return (r->run_in_use[run][slot / 64] >> (slot % 64)) & 1;
+}
+
+void *arena_malloc(size_t size) {
+    if (size == 0 || size > ARENA_MAX_SIZE) {
+        return NULL;
+    }
+    int c = arena_class_of(size);
+    struct arena_class *cls = &arena_classes[c];
+    void *p;
+
+    if (cls->free_list) {
+        // reuse a freed object of the same class first, it sits in a page that is already in use
+        p = cls->free_list;
+        cls->free_list = *(void **)p;
+    } else {
+        size_t obj = arena_class_size(c);
+        if (!cls->region || cls->region->run_top[cls->run] + obj > arena_run_capacity(cls->run)) {
+            if (!arena_new_run(c)) {
+                return NULL;
+            }
+        }
+        struct arena_region *r = cls->region;
+        p = arena_run_start(r, cls->run) + r->run_top[cls->run];
+        r->run_top[cls->run] += obj;
+    }
+
+    struct arena_region *r = (struct arena_region *)((size_t)p & ~(size_t)(ARENA_REGION_SIZE - 1));
+    size_t run = ((char *)p - (char *)r) / ARENA_RUN_SIZE;
+    size_t slot = (size_t)((char *)p - arena_run_start(r, run)) / arena_class_size(c);
+    r->run_in_use[run][slot / 64] |= (uint64_t)1 << (slot % 64);
+    r->run_live[run]++;
+    cls->live++;
+    return p;
+}
+
+// gives an emptied run back to the kernel: its objects leave the class free list first,
+// since MADV_DONTNEED drops the next pointers stored in them
+void arena_return_run(struct arena_region *r, size_t run) {
+    struct arena_class *cls = &arena_classes[r->run_class[run]];
+    char *start = arena_run_start(r, run);
+    char *end = (char *)r + (run + 1) * ARENA_RUN_SIZE;
+    void **link = &cls->free_list;
+    while (*link) {
+        if ((char *)*link >= start && (char *)*link < end) {
+            *link = *(void **)*link;
+        } else {
+            link = (void **)*link;
+        }
+    }
+    madvise(start, end - start, MADV_DONTNEED);
+    r->run_top[run] = 0;
+    r->run_class[run] = ARENA_NO_CLASS;
+    r->runs_returned++;
+    arena_runs_returned++;
+}
+
+// returns an object to its size class; false (and nothing is touched) if p is not
+// an object currently handed out by the arena, e.g. a stray pointer or a double free
+bool arena_free(struct arena_region *r, void *p) {
+    size_t run, slot;
+    if (!arena_slot_of(r, p, &run, &slot) || !arena_slot_in_use(r, run, slot)) {
+        return false;
+    }
+    r->run_in_use[run][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    struct arena_class *cls = &arena_classes[r->run_class[run]];
+    *(void **)p = cls->free_list;
+    cls->free_list = p;
+    r->run_live[run]--;
+    cls->live--;
+    if (r->run_live[run] == 0 && !(cls->region == r && cls->run == run)) {
+        arena_return_run(r, run);  // the run being carved stays, it is about to be used again
+    }
+    return true;
+}
+
+/* Page footprint of the arena and of the sbrk heap, to compare against dTLB misses in perf */
+struct page_footprint {
+    size_t regions;         // 2MB regions reserved by the arena
+    size_t runs;            // runs handed out to size classes
+    size_t runs_returned;   // runs emptied and given back to the kernel
+    size_t arena_pages;     // 4K pages the arena has carved objects from
+    size_t arena_live;      // bytes in live arena objects
+    size_t heap_pages;      // distinct 4K pages spanned by blocks in use on the sbrk heap
+    size_t heap_live;       // bytes in blocks in use on the sbrk heap
+};
+
+struct page_footprint mmu_page_footprint(void) {
+    struct page_footprint f = {0, 0, 0, 0, 0, 0, 0};
+    for (struct arena_region *r = arena_regions; r; r = r->next) {
+        f.regions++;
+        f.runs_returned += r->runs_returned;
+        for (size_t run = 0; run < r->runs_used; run++) {
+            if (r->run_class[run] == ARENA_NO_CLASS) {
+                continue;
+            }
+            f.runs++;
+            f.arena_pages += (r->run_top[run] + ARENA_PAGE_SIZE - 1) / ARENA_PAGE_SIZE;
+            f.arena_live += r->run_live[run] * arena_class_size(r->run_class[run]);
+        }
+    }
+    // the block list is in address order, so a page shared by neighbouring blocks is counted once
+    size_t last_page = (size_t)-1;
+    for (mem_ptr b = mem_list.head; b; b = b->next) {
+        if (b->free) {
+            continue;
+        }
+        size_t first = (size_t)b / ARENA_PAGE_SIZE;
+        size_t last = ((size_t)b->data + b->size - 1) / ARENA_PAGE_SIZE;
+        if (first == last_page) {
+            first++;
+        }
+        if (last >= first) {
+            f.heap_pages += last - first + 1;
+        }
+        last_page = last;
+        f.heap_live += b->size;
+    }
+    return f;
+}
+
+void mmu_print_page_footprint(FILE *out) {
+    struct page_footprint f = mmu_page_footprint();
+    fprintf(out, "arena: %zu regions (%zu MB reserved), %zu runs (%zu returned), %zu pages touched, %zu live bytes (%.1f%% of touched)\n",
+            f.regions, f.regions * (ARENA_REGION_SIZE >> 20), f.runs, f.runs_returned, f.arena_pages, f.arena_live,
+            f.arena_pages ? 100.0 * f.arena_live / (f.arena_pages * ARENA_PAGE_SIZE) : 0.0);
+    fprintf(out, "heap:  %zu pages spanned by %zu live bytes (%.1f%% of spanned)\n",
+            f.heap_pages, f.heap_live,
+            f.heap_pages ? 100.0 * f.heap_live / (f.heap_pages * ARENA_PAGE_SIZE) : 0.0);
+}
+
 void* my_malloc(size_t size) {
+    // in arena mode small requests are served from the huge-page regions
+    if (arena_mode && size > 0 && size <= ARENA_MAX_SIZE) {
+        void *p = arena_malloc(size);
+        if (p) return p;
+    }
     // aims to emulate the standard malloc() function 
     mem_ptr block, last = NULL;
     size_t aligned_size = align4(size);
@@ -187,7 +539,13 @@ int is_addr_valid(void* p) {
 }
 
 void my_free(void* ptr) {
-    if (is_addr_valid(ptr)) {
+    struct arena_region *region = arena_region_of(ptr);
+    if (region) {
+        // objects from the arena go back to their size class
+        if (!arena_free(region, ptr)) {
+            printf("Pointer %p is not valid.\n", ptr);
+        }
+    } else if (is_addr_valid(ptr)) {
         mem_ptr block = (mem_ptr)((char*)ptr - offsetof(struct mem_block, data));
         block->free = true;  // block is marked as free 
 
@@ -0,0 +1,88 @@
+#ifndef FILE_TAIL_H
+#define FILE_TAIL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Incremental reader for an append-only file (shared-file.txt)
+// The descriptor is opened once and shared by every reader thread (pread() has no file position).
+// 'offset' marks the end of the last complete line that has been processed, so a reader only
+// preads the bytes appended since then instead of rescanning the file from the start.
+// Only one reader reads the tail at a time: a reader that finds another one already reading
+// returns at once instead of preading and scanning the same bytes again, since those lines are
+// being processed by the other reader. The work done per read therefore depends on what was
+// appended, not on the size of the file or the number of readers. Lines appended after the
+// busy reader reached the end are left for the next call. The file is never truncated, so
+// whatever it already holds when tail_open() returns must be consumed once with tail_read()
+// before the reader threads start; otherwise the first reader would scan the whole file
+// inside the read lock.
+
+#define TAIL_CHUNK 4096
+
+typedef struct {
+    int fd;
+    pthread_mutex_t reading;  // held by the reader that is reading the tail
+    uint64_t offset;          // end of the last processed line (reading held)
+} file_tail_t;
+
+/* Opens 'path' for reading, returns -1 with errno set on failure */
+static inline int tail_open(file_tail_t *t, const char *path) {
+    t->fd = open(path, O_RDONLY | O_CLOEXEC);
+    t->offset = 0;
+    if (t->fd < 0) {
+        return -1;
+    }
+    pthread_mutex_init(&t->reading, NULL);
+    return 0;
+}
+
+/* Processes the lines appended since the last call, returns how many were new (or -1) */
+static inline long tail_read(file_tail_t *t) {
+    if (pthread_mutex_trylock(&t->reading) != 0) {
+        return 0;  // another reader is processing the new lines right now
+    }
+    char chunk[TAIL_CHUNK];
+    uint64_t pos = t->offset;        // next byte to pread
+    uint64_t complete = t->offset;   // end of the last complete line seen
+    long found = 0;
+
+    for (;;) {
+        ssize_t n = pread(t->fd, chunk, sizeof(chunk), (off_t)pos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            found = -1;
+            break;
+        }
+        if (n == 0) {
+            break;  // reached the current end of the file
+        }
+        const char *p = chunk;
+        const char *end = chunk + n;
+        const char *nl;
+        while ((nl = memchr(p, '\n', end - p)) != NULL) {
+            // Process each new line from shared-file.txt if needed
+            found++;
+            complete = pos + (uint64_t)(nl + 1 - chunk);
+            p = nl + 1;
+        }
+        pos += (uint64_t)n;
+    }
+
+    // a partial last line is left for the next reader; lines processed before an error stay processed
+    t->offset = complete;
+    pthread_mutex_unlock(&t->reading);
+    return found;
+}
+
+static inline void tail_close(file_tail_t *t) {
+    close(t->fd);
+    pthread_mutex_destroy(&t->reading);
+}
+
+#endif  // FILE_TAIL_H
@@ -0,0 +1,276 @@
+#ifndef FUTEX_RWLOCK_H
+#define FUTEX_RWLOCK_H
+
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Reader-writer lock built directly on atomics and futex (Linux only)
+// Replaces the stack of semaphores used by the rw programs
+// The uncontended paths are a single atomic operation and never enter the kernel,
+// threads only sleep in futex_wait() once a short spin has not been enough
+
+/* The policy used to decide who goes next when readers and writers compete */
+typedef enum {
+    FRW_PREFER_READER,  // readers enter whenever no writer holds the lock (writers can starve)
+    FRW_PREFER_WRITER,  // a waiting writer blocks new readers (readers can starve)
+    FRW_PHASE_FAIR      // read and write phases alternate, so every wait is bounded
+} frw_mode_t;
+
+/* Layout of 'state' for the two preference modes */
+#define FRW_RD_ONE     0x00000001u  // one active reader
+#define FRW_RD_MASK    0x0000FFFFu  // number of active readers
+#define FRW_WW_ONE     0x00010000u  // one waiting writer
+#define FRW_WW_MASK    0x7FFF0000u  // number of waiting writers
+#define FRW_WR_ACTIVE  0x80000000u  // a writer holds the lock
+
+/* Thread limits implied by the fields above; more would carry into the next field */
+#define FRW_MAX_READERS  (FRW_RD_MASK / FRW_RD_ONE)
+#define FRW_MAX_WRITERS  (FRW_WW_MASK / FRW_WW_ONE)
+
+/* Layout of 'rin' / 'rout' for the phase-fair mode (Brandenburg & Anderson, PF-T) */
+#define FRW_PF_RINC    0x100u  // reader increment, readers are counted above the low byte
+#define FRW_PF_WBITS   0x3u    // writer present + phase id
+#define FRW_PF_PRES    0x2u    // a writer is present
+#define FRW_PF_PHID    0x1u    // phase id of the present writer
+
+#define FRW_SPIN 128  // number of polls before a thread goes to sleep
+
+typedef struct {
+    _Atomic uint32_t state;     // reader count, waiting writers and writer bit (preference modes)
+    _Atomic uint32_t rin;       // readers that arrived + writer bits (phase-fair)
+    _Atomic uint32_t rout;      // readers that left (phase-fair)
+    _Atomic uint32_t win;       // writer tickets handed out (phase-fair)
+    _Atomic uint32_t wout;      // writer tickets served (phase-fair)
+    _Atomic uint32_t sleepers;  // threads currently inside futex_wait()
+    frw_mode_t mode;
+} frw_lock_t;
+
+static inline void frw_init(frw_lock_t *l, frw_mode_t mode) {
+    atomic_init(&l->state, 0);
+    atomic_init(&l->rin, 0);
+    atomic_init(&l->rout, 0);
+    atomic_init(&l->win, 0);
+    atomic_init(&l->wout, 0);
+    atomic_init(&l->sleepers, 0);
+    l->mode = mode;
+}
+
+static inline void frw_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// sleeps on 'word' as long as it still holds 'seen'
+// the sleepers count is raised before the kernel re-checks the word, so a waker that changed
+// the word either sees sleepers > 0 or the kernel sees the new value and does not put us to sleep
+static inline void frw_wait(frw_lock_t *l, _Atomic uint32_t *word, uint32_t seen) {
+    for (int i = 0; i < FRW_SPIN; i++) {
+        if (atomic_load_explicit(word, memory_order_relaxed) != seen) {
+            return;
+        }
+        frw_cpu_relax();
+    }
+    atomic_fetch_add(&l->sleepers, 1);
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+    atomic_fetch_sub(&l->sleepers, 1);
+}
+
+// wakes everyone sleeping on 'word', but only pays for the syscall if someone is asleep
+static inline void frw_wake(frw_lock_t *l, _Atomic uint32_t *word) {
+    if (atomic_load(&l->sleepers) != 0) {
+        syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+// like frw_wait(), but the sleeper is tagged with 'bits' so a waker can pick it out
+static inline void frw_wait_bits(frw_lock_t *l, _Atomic uint32_t *word, uint32_t seen, uint32_t bits) {
+    for (int i = 0; i < FRW_SPIN; i++) {
+        if (atomic_load_explicit(word, memory_order_relaxed) != seen) {
+            return;
+        }
+        frw_cpu_relax();
+    }
+    atomic_fetch_add(&l->sleepers, 1);
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT_BITSET_PRIVATE, seen, NULL, NULL, bits);
+    atomic_fetch_sub(&l->sleepers, 1);
+}
+
+// wakes only the sleepers on 'word' whose tag shares a bit with 'bits'
+static inline void frw_wake_bits(frw_lock_t *l, _Atomic uint32_t *word, uint32_t bits) {
+    if (atomic_load(&l->sleepers) != 0) {
+        syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE_BITSET_PRIVATE, INT_MAX, NULL, NULL, bits);
+    }
+}
+
+// writers waiting for their ticket sleep tagged with one bit per ticket (mod 32),
+// so a handoff wakes the next ticket holder instead of every queued writer
+static inline uint32_t frw_ticket_bit(uint32_t ticket) {
+    return 1u << (ticket & 31);
+}
+
+/* ---------- phase-fair mode ---------- */
+
+static inline void frw_pf_read_lock(frw_lock_t *l) {
+    // announce ourselves, if a writer is present wait until its phase is over
+    uint32_t w = atomic_fetch_add(&l->rin, FRW_PF_RINC) & FRW_PF_WBITS;
+    if (w == 0) {
+        return;
+    }
+    for (;;) {
+        uint32_t v = atomic_load(&l->rin);
+        if ((v & FRW_PF_WBITS) != w) {
+            return;
+        }
+        frw_wait(l, &l->rin, v);
+    }
+}
+
+static inline void frw_pf_read_unlock(frw_lock_t *l) {
+    atomic_fetch_add(&l->rout, FRW_PF_RINC);
+    if (atomic_load(&l->rin) & FRW_PF_PRES) {
+        frw_wake(l, &l->rout);  // a writer may be waiting for the readers to drain
+    }
+}
+
+static inline void frw_pf_write_lock(frw_lock_t *l) {
+    // writers are served in ticket order
+    uint32_t ticket = atomic_fetch_add(&l->win, 1);
+    for (;;) {
+        uint32_t v = atomic_load(&l->wout);
+        if (v == ticket) {
+            break;
+        }
+        frw_wait_bits(l, &l->wout, v, frw_ticket_bit(ticket));
+    }
+    // block readers arriving from now on, then wait for those already inside to leave
+    uint32_t w = FRW_PF_PRES | (ticket & FRW_PF_PHID);
+    uint32_t readers_in = atomic_fetch_add(&l->rin, w) & ~FRW_PF_WBITS;
+    for (;;) {
+        uint32_t v = atomic_load(&l->rout);
+        if (v == readers_in) {
+            break;
+        }
+        frw_wait(l, &l->rout, v);
+    }
+}
+
+static inline void frw_pf_write_unlock(frw_lock_t *l) {
+    // start the next read phase first, then hand over to the next writer
+    atomic_fetch_and(&l->rin, ~FRW_PF_WBITS);
+    frw_wake(l, &l->rin);
+    uint32_t next = atomic_fetch_add(&l->wout, 1) + 1;
+    frw_wake_bits(l, &l->wout, frw_ticket_bit(next));
+}
+
+/* ---------- reader / writer preference modes ---------- */
+
+static inline int frw_reader_blocked(const frw_lock_t *l, uint32_t s) {
+    if (s & FRW_WR_ACTIVE) {
+        return 1;
+    }
+    return l->mode == FRW_PREFER_WRITER && (s & FRW_WW_MASK) != 0;
+}
+
+static inline void frw_read_lock(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        frw_pf_read_lock(l);
+        return;
+    }
+    uint32_t s = atomic_load_explicit(&l->state, memory_order_relaxed);
+    for (;;) {
+        if (!frw_reader_blocked(l, s)) {
+            if (atomic_compare_exchange_weak(&l->state, &s, s + FRW_RD_ONE)) {
+                return;
+            }
+            continue;  // s now holds the fresh value
+        }
+        frw_wait(l, &l->state, s);
+        s = atomic_load(&l->state);
+    }
+}
+
+static inline void frw_read_unlock(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        frw_pf_read_unlock(l);
+        return;
+    }
+    uint32_t s = atomic_fetch_sub(&l->state, FRW_RD_ONE);
+    if ((s & FRW_RD_MASK) == 1 && (s & FRW_WW_MASK)) {
+        frw_wake(l, &l->state);  // last reader out lets a waiting writer in
+    }
+}
+
+static inline void frw_write_lock(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        frw_pf_write_lock(l);
+        return;
+    }
+    uint32_t s = 0;
+    if (atomic_compare_exchange_strong(&l->state, &s, FRW_WR_ACTIVE)) {
+        return;  // fast path: lock was completely free
+    }
+    // register as a waiting writer, which also holds off new readers in writer-pref mode
+    s = atomic_fetch_add(&l->state, FRW_WW_ONE) + FRW_WW_ONE;
+    for (;;) {
+        if ((s & (FRW_RD_MASK | FRW_WR_ACTIVE)) == 0) {
+            if (atomic_compare_exchange_weak(&l->state, &s, s - FRW_WW_ONE + FRW_WR_ACTIVE)) {
+                return;
+            }
+            continue;
+        }
+        frw_wait(l, &l->state, s);
+        s = atomic_load(&l->state);
+    }
+}
+
+static inline void frw_write_unlock(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        frw_pf_write_unlock(l);
+        return;
+    }
+    atomic_fetch_and(&l->state, ~FRW_WR_ACTIVE);
+    frw_wake(l, &l->state);
+}
+
+/* ---------- try-acquire (used to tell contended acquisitions apart) ---------- */
+
+/* Takes the read lock only if that needs no waiting, returns 1 on success */
+static inline int frw_try_read_lock(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        uint32_t v = atomic_load(&l->rin);
+        return (v & FRW_PF_WBITS) == 0 && atomic_compare_exchange_strong(&l->rin, &v, v + FRW_PF_RINC);
+    }
+    uint32_t s = atomic_load_explicit(&l->state, memory_order_relaxed);
+    return !frw_reader_blocked(l, s) && atomic_compare_exchange_strong(&l->state, &s, s + FRW_RD_ONE);
+}
+
+/* Takes the write lock only if it is completely free, returns 1 on success, never waits.
+   In the phase-fair mode a writer has to draw a ticket before it can block readers, and a
+   ticket cannot be given back if a reader slips in meanwhile, so there is no non-blocking
+   way to take it: the try always fails there and every write goes through frw_write_lock(). */
+static inline int frw_try_write_lock(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        return 0;
+    }
+    uint32_t s = 0;
+    return atomic_compare_exchange_strong(&l->state, &s, FRW_WR_ACTIVE);
+}
+
+/* Number of readers currently inside the critical section (for logging) */
+static inline int frw_readers(frw_lock_t *l) {
+    if (l->mode == FRW_PHASE_FAIR) {
+        uint32_t in = atomic_load(&l->rin) & ~FRW_PF_WBITS;
+        uint32_t out = atomic_load(&l->rout);
+        return (int)((in - out) / FRW_PF_RINC);
+    }
+    return (int)(atomic_load(&l->state) & FRW_RD_MASK);
+}
+
+#endif  // FUTEX_RWLOCK_H
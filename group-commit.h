@@ -0,0 +1,201 @@
+#ifndef GROUP_COMMIT_H
+#define GROUP_COMMIT_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Group-commit appender for the files the rw programs append to
+// The file is opened once with O_APPEND. Threads queue their record in the pending buffer;
+// the first one to find no flush in progress becomes the leader and writes everything queued
+// so far with one write(), the others just wait until their record is part of a finished batch.
+// Records that arrive while the leader is writing are picked up by the leader's next round,
+// so under load many appends share one syscall and no record is ever split or interleaved.
+// A leader writes at most GC_MAX_ROUNDS batches and then hands off to one of the waiting
+// threads, so a thread that happens to become leader (possibly while holding rw_lock) is not
+// kept busy flushing other threads' records for as long as they keep arriving.
+// Every caller gets the result of the batch that held its own record: batches cover
+// contiguous sequence numbers, and the ranges of failed batches are kept in 'failed' together
+// with the write() error, which a caller whose record was lost finds in errno.
+
+#define GC_MAX_ROUNDS 2  // the leader's own batch plus one more
+
+typedef struct {
+    uint64_t first;  // first sequence number of a run of failed batches
+    uint64_t last;   // last sequence number of that run
+    int error;       // errno of the failed write()
+} gc_failed_range_t;
+
+typedef struct {
+    int fd;
+    pthread_mutex_t mutex;
+    pthread_cond_t flushed;   // signalled after every batch
+    char *pending;            // records queued for the next batch
+    size_t pending_len;
+    size_t pending_cap;
+    char *writing;            // the batch the leader is writing (swapped with pending)
+    size_t writing_cap;
+    uint64_t queued_seq;      // sequence number of the last queued record
+    uint64_t flushed_seq;     // every record up to here is in the file
+    int flushing;             // a leader is writing
+    gc_failed_range_t *failed;  // sequence ranges whose write() failed (only grows on errors)
+    size_t failed_count;
+    size_t failed_cap;
+} group_log_t;
+
+/* Opens (creating if needed) 'path' for appending, returns -1 with errno set on failure */
+static inline int gc_open(group_log_t *g, const char *path) {
+    memset(g, 0, sizeof(*g));
+    g->fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (g->fd < 0) {
+        return -1;
+    }
+    pthread_mutex_init(&g->mutex, NULL);
+    pthread_cond_init(&g->flushed, NULL);
+    return 0;
+}
+
+// writes the whole buffer, retrying on short writes and EINTR
+static inline int gc_write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// makes room for 'extra' more bytes in the pending buffer (mutex held)
+static inline int gc_reserve(group_log_t *g, size_t extra) {
+    if (g->pending_len + extra <= g->pending_cap) {
+        return 0;
+    }
+    size_t cap = g->pending_cap ? g->pending_cap : 4096;
+    while (g->pending_len + extra > cap) {
+        cap *= 2;
+    }
+    char *bigger = realloc(g->pending, cap);
+    if (!bigger) {
+        return -1;
+    }
+    g->pending = bigger;
+    g->pending_cap = cap;
+    return 0;
+}
+
+// remembers that the batch with sequence numbers first..last failed with 'error' (mutex held)
+static inline void gc_mark_failed(group_log_t *g, uint64_t first, uint64_t last, int error) {
+    gc_failed_range_t *prev = g->failed_count > 0 ? &g->failed[g->failed_count - 1] : NULL;
+    if (prev && prev->last + 1 == first && prev->error == error) {
+        prev->last = last;  // extends the previous failed run
+        return;
+    }
+    if (g->failed_count == g->failed_cap) {
+        size_t cap = g->failed_cap ? g->failed_cap * 2 : 4;
+        gc_failed_range_t *bigger = realloc(g->failed, cap * sizeof(gc_failed_range_t));
+        if (!bigger) {
+            return;  // out of memory: only the leader of that batch will see the error
+        }
+        g->failed = bigger;
+        g->failed_cap = cap;
+    }
+    g->failed[g->failed_count].first = first;
+    g->failed[g->failed_count].last = last;
+    g->failed[g->failed_count].error = error;
+    g->failed_count++;
+}
+
+// result of the batch that held record 'seq', with errno set on failure (mutex held, the batch must be finished)
+static inline int gc_status(const group_log_t *g, uint64_t seq) {
+    for (size_t i = g->failed_count; i > 0; i--) {
+        if (g->failed[i - 1].first <= seq && seq <= g->failed[i - 1].last) {
+            errno = g->failed[i - 1].error;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Appends one record and returns once it has been written to the file (0) or failed (-1, errno set) */
+static inline int gc_append(group_log_t *g, const char *text, size_t n) {
+    int result, error = 0;
+    pthread_mutex_lock(&g->mutex);
+    if (gc_reserve(g, n) != 0) {
+        pthread_mutex_unlock(&g->mutex);
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(g->pending + g->pending_len, text, n);
+    g->pending_len += n;
+    uint64_t my_seq = ++g->queued_seq;
+
+    // follower: the current or a later batch will contain our record,
+    // unless the leader hands off first, in which case we take over
+    while (g->flushed_seq < my_seq && g->flushing) {
+        pthread_cond_wait(&g->flushed, &g->mutex);
+    }
+    if (g->flushed_seq >= my_seq) {
+        result = gc_status(g, my_seq);
+        pthread_mutex_unlock(&g->mutex);
+        return result;
+    }
+
+    // leader: our record is still pending, write a bounded number of batches
+    result = 0;
+    g->flushing = 1;
+    for (int round = 0; round < GC_MAX_ROUNDS && g->pending_len > 0; round++) {
+        char *batch = g->pending;
+        size_t batch_cap = g->pending_cap;
+        size_t len = g->pending_len;
+        uint64_t batch_seq = g->queued_seq;
+        g->pending = g->writing;  // followers queue into the other buffer meanwhile
+        g->pending_cap = g->writing_cap;
+        g->pending_len = 0;
+        g->writing = batch;
+        g->writing_cap = batch_cap;
+
+        pthread_mutex_unlock(&g->mutex);
+        int failed = gc_write_all(g->fd, batch, len) != 0;
+        int write_error = errno;
+        pthread_mutex_lock(&g->mutex);
+
+        if (failed) {
+            gc_mark_failed(g, g->flushed_seq + 1, batch_seq, write_error);
+            if (round == 0) {
+                result = -1;  // our own record was in the first batch
+                error = write_error;
+            }
+        }
+        g->flushed_seq = batch_seq;
+        pthread_cond_broadcast(&g->flushed);
+    }
+    // hand off: a thread whose record is still pending wakes up and becomes the next leader
+    g->flushing = 0;
+    pthread_cond_broadcast(&g->flushed);
+    pthread_mutex_unlock(&g->mutex);
+    if (result != 0) {
+        errno = error;
+    }
+    return result;
+}
+
+static inline void gc_close(group_log_t *g) {
+    close(g->fd);
+    free(g->pending);
+    free(g->writing);
+    free(g->failed);
+    pthread_mutex_destroy(&g->mutex);
+    pthread_cond_destroy(&g->flushed);
+}
+
+#endif  // GROUP_COMMIT_H
@@ -0,0 +1,210 @@
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "futex-rwlock.h"
+
+// Contention instrumentation for the lock call sites in the rw programs
+// Each call site (e.g. "rw_lock.read") gets an id from lstat_register(). An frw_lock_t is taken
+// and released through lstat_read_lock() / lstat_read_unlock() (and the write versions), which
+// wrap the lock like this, so other locks can be instrumented with the same calls:
+//
+//     lstat_wait_begin(id);
+//     if (!<try-acquire>) { lstat_wait_slow(id); <acquire>; }
+//     lstat_wait_end(id);  ...  <release>  lstat_release(id);
+//
+// Wait time, hold time and acquisition counts go into a per-thread buffer that only its owner
+// writes, so recording needs no locks and no shared cache lines. The only shared write is the
+// per-site waiter count used for the maximum queue depth, and it is only touched on the slow
+// path, by threads that really have to wait. Buffers are linked into a global list with a CAS
+// the first time a thread records, and a summary is printed to stderr at exit.
+//
+// Recording is off unless LOCK_STATS is set in the environment, in which case an uncontended
+// acquisition costs two clock_gettime() calls (vDSO, no syscall) and no shared writes.
+
+#define LSTAT_MAX_SITES 8
+
+typedef struct lstat_thread {
+    uint64_t acquisitions[LSTAT_MAX_SITES];
+    uint64_t contended[LSTAT_MAX_SITES];  // acquisitions that had to take the slow path
+    uint64_t wait_ns[LSTAT_MAX_SITES];
+    uint64_t wait_max[LSTAT_MAX_SITES];
+    uint64_t hold_ns[LSTAT_MAX_SITES];
+    uint64_t hold_max[LSTAT_MAX_SITES];
+    uint32_t depth_max[LSTAT_MAX_SITES];
+    uint64_t started[LSTAT_MAX_SITES];   // when the current wait / hold began
+    unsigned char queued[LSTAT_MAX_SITES];  // counted in the site's waiter count right now
+    struct lstat_thread *next;
+} lstat_thread_t;
+
+typedef struct {
+    const char *name;
+    _Atomic uint32_t waiting;  // threads currently waiting on the slow path of this site
+    char pad[64];              // keep sites on separate cache lines
+} lstat_site_t;
+
+static lstat_site_t lstat_sites[LSTAT_MAX_SITES];
+static int lstat_site_count = 0;
+static int lstat_enabled = 0;
+static _Atomic(lstat_thread_t *) lstat_threads = NULL;
+static __thread lstat_thread_t *lstat_self = NULL;
+
+static inline uint64_t lstat_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// returns the calling thread's buffer, creating and publishing it on first use
+static inline lstat_thread_t *lstat_thread(void) {
+    if (lstat_self) {
+        return lstat_self;
+    }
+    lstat_thread_t *t = calloc(1, sizeof(lstat_thread_t));
+    if (!t) {
+        return NULL;
+    }
+    t->next = atomic_load(&lstat_threads);
+    while (!atomic_compare_exchange_weak(&lstat_threads, &t->next, t)) {
+        // t->next was refreshed by the failed CAS
+    }
+    lstat_self = t;
+    return t;
+}
+
+static inline void lstat_wait_begin(int id) {
+    if (!lstat_enabled || id < 0) {
+        return;
+    }
+    lstat_thread_t *t = lstat_thread();
+    if (!t) {
+        return;
+    }
+    t->started[id] = lstat_now();
+}
+
+// the try-acquire failed: this thread now really waits, count it in the queue depth
+static inline void lstat_wait_slow(int id) {
+    if (!lstat_enabled || id < 0 || !lstat_self) {
+        return;
+    }
+    lstat_thread_t *t = lstat_self;
+    uint32_t depth = atomic_fetch_add_explicit(&lstat_sites[id].waiting, 1, memory_order_relaxed) + 1;
+    if (depth > t->depth_max[id]) {
+        t->depth_max[id] = depth;
+    }
+    t->queued[id] = 1;
+    t->contended[id]++;
+}
+
+static inline void lstat_wait_end(int id) {
+    if (!lstat_enabled || id < 0 || !lstat_self) {
+        return;
+    }
+    lstat_thread_t *t = lstat_self;
+    if (t->queued[id]) {
+        atomic_fetch_sub_explicit(&lstat_sites[id].waiting, 1, memory_order_relaxed);
+        t->queued[id] = 0;
+    }
+    uint64_t now = lstat_now();
+    uint64_t waited = now - t->started[id];
+    t->acquisitions[id]++;
+    t->wait_ns[id] += waited;
+    if (waited > t->wait_max[id]) {
+        t->wait_max[id] = waited;
+    }
+    t->started[id] = now;  // the hold starts here
+}
+
+static inline void lstat_release(int id) {
+    if (!lstat_enabled || id < 0 || !lstat_self) {
+        return;
+    }
+    lstat_thread_t *t = lstat_self;
+    uint64_t held = lstat_now() - t->started[id];
+    t->hold_ns[id] += held;
+    if (held > t->hold_max[id]) {
+        t->hold_max[id] = held;
+    }
+}
+
+/* frw_read_lock() / frw_write_lock() recorded under call site 'id' */
+static inline void lstat_read_lock(int id, frw_lock_t *l) {
+    lstat_wait_begin(id);
+    if (!frw_try_read_lock(l)) {
+        lstat_wait_slow(id);
+        frw_read_lock(l);
+    }
+    lstat_wait_end(id);
+}
+
+static inline void lstat_write_lock(int id, frw_lock_t *l) {
+    lstat_wait_begin(id);
+    if (!frw_try_write_lock(l)) {
+        lstat_wait_slow(id);
+        frw_write_lock(l);
+    }
+    lstat_wait_end(id);
+}
+
+static inline void lstat_read_unlock(int id, frw_lock_t *l) {
+    frw_read_unlock(l);
+    lstat_release(id);
+}
+
+static inline void lstat_write_unlock(int id, frw_lock_t *l) {
+    frw_write_unlock(l);
+    lstat_release(id);
+}
+
+/* Sums every thread's buffer and prints one line per call site */
+static void lstat_dump(void) {
+    fprintf(stderr, "%-14s %10s %10s %14s %12s %14s %12s %9s\n", "lock-site", "acquired",
+            "contended", "avg-wait(ns)", "max-wait(us)", "avg-hold(ns)", "max-hold(us)", "max-queue");
+    for (int id = 0; id < lstat_site_count; id++) {
+        uint64_t acquired = 0, contended = 0, wait = 0, wait_max = 0, hold = 0, hold_max = 0;
+        uint32_t depth_max = 0;
+        for (lstat_thread_t *t = atomic_load(&lstat_threads); t; t = t->next) {
+            acquired += t->acquisitions[id];
+            contended += t->contended[id];
+            wait += t->wait_ns[id];
+            hold += t->hold_ns[id];
+            if (t->wait_max[id] > wait_max) wait_max = t->wait_max[id];
+            if (t->hold_max[id] > hold_max) hold_max = t->hold_max[id];
+            if (t->depth_max[id] > depth_max) depth_max = t->depth_max[id];
+        }
+        fprintf(stderr, "%-14s %10llu %10llu %14llu %12llu %14llu %12llu %9u\n", lstat_sites[id].name,
+                (unsigned long long)acquired,
+                (unsigned long long)contended,
+                (unsigned long long)(acquired ? wait / acquired : 0),
+                (unsigned long long)(wait_max / 1000),
+                (unsigned long long)(acquired ? hold / acquired : 0),
+                (unsigned long long)(hold_max / 1000),
+                depth_max);
+    }
+}
+
+/* Reads LOCK_STATS from the environment, call once from main() before any thread starts */
+static inline void lstat_init(void) {
+    const char *env = getenv("LOCK_STATS");
+    lstat_enabled = env && env[0] && env[0] != '0';
+    if (lstat_enabled) {
+        atexit(lstat_dump);
+    }
+}
+
+/* Names a call site, call from main() before any thread starts; returns -1 when full (not recorded) */
+static inline int lstat_register(const char *name) {
+    if (lstat_site_count == LSTAT_MAX_SITES) {
+        return -1;
+    }
+    lstat_sites[lstat_site_count].name = name;
+    atomic_init(&lstat_sites[lstat_site_count].waiting, 0);
+    return lstat_site_count++;
+}
+
+#endif  // LOCK_STATS_H
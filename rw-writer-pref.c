@@ -1,60 +1,57 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
-#include <semaphore.h>
+#include <string.h>
 #include <unistd.h>
-
-sem_t mutex;         // Controls access to reader_count
-sem_t rw_lock;       // Controls access to the shared resource
-sem_t queue_lock;    // Blocks new readers when a writer is waiting
-sem_t count_l;
-int reader_count = 0; // Number of active readers
+#include "futex-rwlock.h"
+#include "shared-snapshot.h"
+#include "lock-stats.h"
+#include "group-commit.h"
+#include "file-tail.h"
+
+frw_lock_t rw_lock;  // Controls access to the shared resource, waiting writers block new readers
+shared_snapshot_t shared; // In-memory versions of shared-file.txt
+int snapshot_mode = 0;    // Readers use the published snapshot instead of the lock
+int read_site, write_site; // Instrumented call sites of rw_lock (see lock-stats.h)
+group_log_t output_log;   // output-writer-pref.txt, opened once, appends are group-committed
+group_log_t shared_log;   // shared-file.txt, opened once for appending
+file_tail_t shared_tail;  // shared-file.txt, opened once for reading from the last processed line
+char (*snapshot_log)[64]; // One log line per snapshot reader, written to output_log after the join
+
+void read_snapshot(int id) {
+    // Reading section, no lock needed: the version we load is never modified by writers
+    const snapshot_t *snap = snapshot_acquire(&shared);
+
+    // The log line goes into this reader's own slot, main() appends the slots after the join,
+    // so a snapshot reader never takes the log mutex or writes shared memory
+    snprintf(snapshot_log[id - 1], sizeof(snapshot_log[id - 1]), "Reading,Snapshot-version:%llu,Lines:%zu\n",
+             (unsigned long long)snap->version, snap->lines);
+    sleep(1);  // Simulate reading time
+}
 
 void *reader(void *arg) {
     int id = *(int *)arg;
 
-    // Entry section for readers
-    sem_wait(&mutex);           // Acquire mutex to modify reader_count
-    sem_wait(&queue_lock);      // Ensure no new readers if a writer is waiting
-
-    sem_wait(&count_l);
-    
-    reader_count++;
-    if (reader_count == 1) {
-        sem_post(&count_l);
-        sem_wait(&rw_lock);     // First reader locks the resource
-    } else {
-        sem_post(&count_l);
+    if (snapshot_mode) {
+        read_snapshot(id);
+        return NULL;
     }
 
-    sem_post(&queue_lock);      // Allow other readers if no writer is waiting
-    sem_post(&mutex);           // Release mutex after modifying reader_count
-    
+    // Entry section for readers
+    lstat_read_lock(read_site, &rw_lock);    // Waits while a writer holds the lock or is queued for it
 
     // Reading section
-    FILE *output = fopen("output-writer-pref.txt", "a");
-    if (output) {
-        fprintf(output, "Reading,Number-of-readers-present:%d\n", reader_count);
-        fclose(output);
+    char entry[64];
+    int len = snprintf(entry, sizeof(entry), "Reading,Number-of-readers-present:%d\n", frw_readers(&rw_lock));
+    if (gc_append(&output_log, entry, len) != 0) {
+        perror("Failed to write output-writer-pref.txt");
     }
 
-    FILE *input = fopen("shared-file.txt", "r");
-    if (input) {
-        char line[256];
-        while (fgets(line, sizeof(line), input)) {
-            // Process each line from shared_file.txt if needed
-        }
-        fclose(input);
-    }
+    tail_read(&shared_tail);  // Only the lines appended since the last read are processed
     sleep(1);  // Simulate reading time
 
     // Exit section for readers
-    sem_wait(&count_l);           // Acquire countl to modify reader_count
-    reader_count--;
-    if (reader_count == 0) {
-        sem_post(&rw_lock);     // Last reader releases the lock
-    }
-    sem_post(&count_l);           // Release mutex after modifying reader_count
+    lstat_read_unlock(read_site, &rw_lock);  // Last reader out lets a waiting writer in
 
     return NULL;
 }
@@ -63,37 +60,44 @@ void *writer(void *arg) {
     int id = *(int *)arg;
 
     // Entry section for writers
-    sem_wait(&queue_lock);      // Block readers from entering if a writer is waiting
-    sem_wait(&rw_lock);         // Only one writer (or no readers) can access
+    lstat_write_lock(write_site, &rw_lock);  // Blocks new readers while waiting, then gets exclusive access
 
     // Writing section
-    FILE *output = fopen("output-writer-pref.txt", "a");
-    if (output) {
-        fprintf(output, "Writing,Number-of-readers-present:%d\n", reader_count);
-        fclose(output);
+    char entry[64];
+    int len = snprintf(entry, sizeof(entry), "Writing,Number-of-readers-present:%d\n", frw_readers(&rw_lock));
+    if (gc_append(&output_log, entry, len) != 0) {
+        perror("Failed to write output-writer-pref.txt");
     }
 
-    FILE *input = fopen("shared-file.txt", "a");
-    if (input) {
-        fprintf(input, "Hello world!\n");
-        fclose(input);
+    if (gc_append(&shared_log, "Hello world!\n", 13) != 0) {
+        perror("Failed to append to shared-file.txt");
+    }
+    if (snapshot_mode) {
+        snapshot_append(&shared, "Hello world!\n", 13);  // Publish the new version to readers
     }
     sleep(2);  // Simulate writing time
 
     // Exit section for writers
-    sem_post(&rw_lock);         // Release access for others
-    sem_post(&queue_lock);      // Allow new readers and writers to proceed
+    lstat_write_unlock(write_site, &rw_lock);  // Allow new readers and writers to proceed
 
     return NULL;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
+    if (argc != 3 && argc != 4) {
+        return 1;
+    }
+    // Optional third argument "snapshot" switches readers to the lock-free snapshot mode
+    if (argc == 4 && strcmp(argv[3], "snapshot") != 0) {
         return 1;
     }
+    snapshot_mode = (argc == 4);
 
     int n = atoi(argv[1]);
     int m = atoi(argv[2]);
+    if (n < 0 || m < 0 || n > FRW_MAX_READERS || m > FRW_MAX_WRITERS) {
+        return 1;  // the lock state cannot count more threads than this
+    }
 
     pthread_t readers[n], writers[m];
     int ids[n > m ? n : m];
@@ -102,10 +106,28 @@ int main(int argc, char *argv[]) {
         ids[i] = i + 1;
     }
 
-    sem_init(&mutex, 0, 1);         // Initialize mutex for reader count access
-    sem_init(&rw_lock, 0, 1);       // Initialize rw_lock for writer access control
-    sem_init(&queue_lock, 0, 1);    // Initialize queue_lock to control reader access when a writer is waiting
-    sem_init(&count_l, 0, 1);  
+    frw_init(&rw_lock, FRW_PREFER_WRITER);  // Initialize rw_lock with writer preference
+
+    read_site = lstat_register("rw_lock.read");
+    write_site = lstat_register("rw_lock.write");
+    lstat_init();  // LOCK_STATS=1 in the environment prints a contention summary at exit
+
+    if (gc_open(&output_log, "output-writer-pref.txt") != 0 || gc_open(&shared_log, "shared-file.txt") != 0) {
+        perror("Failed to open output files");
+        return 1;
+    }
+    if (tail_open(&shared_tail, "shared-file.txt") != 0) {
+        perror("Failed to open shared-file.txt");
+        return 1;
+    }
+    tail_read(&shared_tail);  // Consume what earlier runs left in the file, outside any lock
+    if (snapshot_mode) {
+        snapshot_log = calloc(n > 0 ? n : 1, sizeof(*snapshot_log));
+        if (!snapshot_log || snapshot_init(&shared, "shared-file.txt") != 0) {
+            perror("Failed to load shared-file.txt");
+            return 1;
+        }
+    }
 
     // Create reader threads
     for (int i = 0; i < n; i++) {
@@ -125,5 +147,17 @@ int main(int argc, char *argv[]) {
         pthread_join(writers[i], NULL);
     }
 
+    if (snapshot_mode) {
+        for (int i = 0; i < n; i++) {
+            if (gc_append(&output_log, snapshot_log[i], strlen(snapshot_log[i])) != 0) {
+                perror("Failed to write output-writer-pref.txt");
+            }
+        }
+        free(snapshot_log);
+        snapshot_destroy(&shared);
+    }
+    tail_close(&shared_tail);
+    gc_close(&shared_log);
+    gc_close(&output_log);
     return 0;
 }
@@ -0,0 +1,297 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "futex-rwlock.h"
+
+// Benchmark for the rwlocks used by rwlock-reader-pref.c and rw-writer-pref.c
+// Every thread loops for a fixed duration, picking a read or a write with the configured ratio,
+// holding the lock for a busy-waited critical section. Acquire latency is recorded in per-thread
+// log-linear histograms, so recording never allocates or touches shared memory.
+//
+// usage: ./rwlock-bench [-t threads] [-r read-percent] [-c cs-ns] [-d seconds] [-p]
+
+/* The lock variants that are compared */
+typedef enum {
+    V_READER_PREF,   // futex rwlock, FRW_PREFER_READER (rwlock-reader-pref.c)
+    V_WRITER_PREF,   // futex rwlock, FRW_PREFER_WRITER (rw-writer-pref.c)
+    V_PHASE_FAIR,    // futex rwlock, FRW_PHASE_FAIR
+    V_PTHREAD,       // pthread_rwlock_t with the default attributes
+    V_COUNT
+} variant_t;
+
+static const char *variant_names[V_COUNT] = {"reader-pref", "writer-pref", "phase-fair", "pthread_rwlock"};
+
+/* Log-linear histogram: 16 linear sub-buckets per power of two, about 6% resolution */
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} histogram_t;
+
+static int hist_index(uint64_t v) {
+    if (v < HIST_SUB) {
+        return (int)v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+    int sub = (int)((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB + sub;
+}
+
+static uint64_t hist_value(int index) {
+    // lower bound of the bucket
+    if (index < HIST_SUB) {
+        return (uint64_t)index;
+    }
+    int msb = index / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(index % HIST_SUB);
+    return (1ull << msb) | (sub << (msb - HIST_SUB_BITS));
+}
+
+static void hist_record(histogram_t *h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    h->total++;
+    if (v > h->max) {
+        h->max = v;
+    }
+}
+
+static void hist_merge(histogram_t *into, const histogram_t *from) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+static uint64_t hist_percentile(const histogram_t *h, double p) {
+    if (h->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p * (double)(h->total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            return hist_value(i);
+        }
+    }
+    return h->max;
+}
+
+/* Benchmark configuration (command line) */
+typedef struct {
+    int threads;
+    int read_percent;
+    long cs_ns;
+    int seconds;
+    int pin;
+} config_t;
+
+/* Per-thread state, padded so threads do not share cache lines */
+typedef struct {
+    int index;
+    uint64_t rng;
+    uint64_t reads;
+    uint64_t writes;
+    histogram_t read_lat;
+    histogram_t write_lat;
+    char pad[64];
+} worker_t;
+
+static config_t cfg = {4, 90, 100, 2, 0};
+static variant_t variant;
+static frw_lock_t frw;
+static pthread_rwlock_t prw;
+static _Atomic int stop;
+static _Atomic int ready;
+static volatile uint64_t shared_counter;  // protected by the lock under test
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t next_rand(uint64_t *s) {
+    // xorshift64, one per thread
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static inline void spin_for(long ns) {
+    if (ns <= 0) {
+        return;
+    }
+    uint64_t until = now_ns() + (uint64_t)ns;
+    while (now_ns() < until) {
+        frw_cpu_relax();
+    }
+}
+
+static inline void bench_read_lock(void) {
+    if (variant == V_PTHREAD) pthread_rwlock_rdlock(&prw);
+    else frw_read_lock(&frw);
+}
+
+static inline void bench_read_unlock(void) {
+    if (variant == V_PTHREAD) pthread_rwlock_unlock(&prw);
+    else frw_read_unlock(&frw);
+}
+
+static inline void bench_write_lock(void) {
+    if (variant == V_PTHREAD) pthread_rwlock_wrlock(&prw);
+    else frw_write_lock(&frw);
+}
+
+static inline void bench_write_unlock(void) {
+    if (variant == V_PTHREAD) pthread_rwlock_unlock(&prw);
+    else frw_write_unlock(&frw);
+}
+
+static void *worker(void *arg) {
+    worker_t *w = arg;
+
+    if (cfg.pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->index % sysconf(_SC_NPROCESSORS_ONLN), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    atomic_fetch_add(&ready, 1);
+    while (atomic_load(&ready) < cfg.threads) {
+        frw_cpu_relax();  // start every thread at the same time
+    }
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        int is_read = (int)(next_rand(&w->rng) % 100) < cfg.read_percent;
+        uint64_t start = now_ns();
+        if (is_read) {
+            bench_read_lock();
+            hist_record(&w->read_lat, now_ns() - start);
+            uint64_t seen = shared_counter;
+            (void)seen;
+            spin_for(cfg.cs_ns);
+            bench_read_unlock();
+            w->reads++;
+        } else {
+            bench_write_lock();
+            hist_record(&w->write_lat, now_ns() - start);
+            shared_counter = shared_counter + 1;
+            spin_for(cfg.cs_ns);
+            bench_write_unlock();
+            w->writes++;
+        }
+    }
+    return NULL;
+}
+
+static void run_variant(variant_t v, worker_t *workers, pthread_t *threads) {
+    variant = v;
+    frw_init(&frw, v == V_WRITER_PREF ? FRW_PREFER_WRITER : v == V_PHASE_FAIR ? FRW_PHASE_FAIR : FRW_PREFER_READER);
+    pthread_rwlock_init(&prw, NULL);
+    atomic_store(&stop, 0);
+    atomic_store(&ready, 0);
+    shared_counter = 0;
+
+    for (int i = 0; i < cfg.threads; i++) {
+        memset(&workers[i], 0, sizeof(worker_t));
+        workers[i].index = i;
+        workers[i].rng = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+    }
+
+    while (atomic_load(&ready) < cfg.threads) {
+        sched_yield();
+    }
+    uint64_t start = now_ns();
+    struct timespec duration = {cfg.seconds, 0};
+    nanosleep(&duration, NULL);
+    atomic_store(&stop, 1);
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    static histogram_t reads, writes;  // 16KB each, kept off the stack
+    memset(&reads, 0, sizeof(reads));
+    memset(&writes, 0, sizeof(writes));
+    uint64_t nr = 0, nw = 0;
+    for (int i = 0; i < cfg.threads; i++) {
+        hist_merge(&reads, &workers[i].read_lat);
+        hist_merge(&writes, &workers[i].write_lat);
+        nr += workers[i].reads;
+        nw += workers[i].writes;
+    }
+    pthread_rwlock_destroy(&prw);
+
+    if (shared_counter != nw) {
+        fprintf(stderr, "%s: lost updates (%llu writes, counter %llu)\n", variant_names[v],
+                (unsigned long long)nw, (unsigned long long)shared_counter);
+    }
+
+    printf("%-15s %12.0f %9llu %9llu %9llu %9llu %9llu %9llu %12.3f\n", variant_names[v],
+           (double)(nr + nw) / elapsed,
+           (unsigned long long)hist_percentile(&reads, 0.50),
+           (unsigned long long)hist_percentile(&reads, 0.99),
+           (unsigned long long)hist_percentile(&reads, 0.999),
+           (unsigned long long)hist_percentile(&writes, 0.50),
+           (unsigned long long)hist_percentile(&writes, 0.99),
+           (unsigned long long)hist_percentile(&writes, 0.999),
+           (double)writes.max / 1e6);  // the longest a writer waited: writer starvation
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "t:r:c:d:p")) != -1) {
+        switch (opt) {
+            case 't': cfg.threads = atoi(optarg); break;
+            case 'r': cfg.read_percent = atoi(optarg); break;
+            case 'c': cfg.cs_ns = atol(optarg); break;
+            case 'd': cfg.seconds = atoi(optarg); break;
+            case 'p': cfg.pin = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-t threads] [-r read-percent] [-c cs-ns] [-d seconds] [-p]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (cfg.threads < 1 || cfg.read_percent < 0 || cfg.read_percent > 100 || cfg.seconds < 1) {
+        fprintf(stderr, "invalid configuration\n");
+        return 1;
+    }
+
+    worker_t *workers = calloc(cfg.threads, sizeof(worker_t));
+    pthread_t *threads = malloc(sizeof(pthread_t) * cfg.threads);
+    if (!workers || !threads) {
+        perror("Failed to allocate worker state");
+        return 1;
+    }
+
+    printf("threads=%d reads=%d%% cs=%ldns duration=%ds pinned=%s\n",
+           cfg.threads, cfg.read_percent, cfg.cs_ns, cfg.seconds, cfg.pin ? "yes" : "no");
+    printf("%-15s %12s %9s %9s %9s %9s %9s %9s %12s\n", "variant", "ops/sec",
+           "rd-p50", "rd-p99", "rd-p999", "wr-p50", "wr-p99", "wr-p999", "wr-max(ms)");
+    printf("%-15s %12s %9s %9s %9s %9s %9s %9s %12s\n", "", "", "(ns)", "(ns)", "(ns)", "(ns)", "(ns)", "(ns)", "");
+    for (int v = 0; v < V_COUNT; v++) {
+        run_variant((variant_t)v, workers, threads);
+    }
+
+    free(workers);
+    free(threads);
+    return 0;
+}
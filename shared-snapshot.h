@@ -0,0 +1,169 @@
+#ifndef SHARED_SNAPSHOT_H
+#define SHARED_SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Versioned in-memory copy of shared-file.txt for a program with a bounded lifetime
+// Writers publish a new version with a single atomic pointer store, readers take a snapshot
+// with a single atomic load and never write to shared memory, so they do not need the rwlock.
+// That only holds if the caller's own reader code stays off shared state too: the rw programs
+// keep each snapshot reader's log line in a per-thread slot and append them after the join.
+// Writers must be serialized among themselves (the rw programs do this with the write lock).
+//
+// The data buffer is append-only: a new version reuses the same buffer and only extends
+// 'len', so bytes a reader can see are never modified. When the buffer is full it is copied
+// into a larger one.
+//
+// There is NO grace period: readers do not announce themselves, so the writer can never tell
+// when an old version is unused. Old versions and buffers are therefore only retired, and all
+// of them are freed in snapshot_destroy() once every thread has been joined. Memory grows by
+// one snapshot_t per write (plus the replaced buffers, at most as much as the current one)
+// until teardown, so this is not suitable for a long-running process with unbounded writes.
+
+typedef struct snapshot {
+    uint64_t version;        // incremented on every publish
+    size_t len;              // number of valid bytes in data
+    size_t lines;            // number of '\n' in data, counted once when it is published
+    const char *data;        // contents of the shared file
+    struct snapshot *retired; // next retired version (writer side only)
+} snapshot_t;
+
+typedef struct retired_buf {
+    char *buf;
+    struct retired_buf *next;
+} retired_buf_t;
+
+typedef struct {
+    _Atomic(snapshot_t *) current;  // the version readers see
+    char *buf;                      // buffer behind the current version
+    size_t cap;                     // capacity of buf
+    snapshot_t *retired;            // versions that have been replaced
+    retired_buf_t *retired_bufs;    // buffers that have been replaced
+} shared_snapshot_t;
+
+// number of newlines in text
+static inline size_t snapshot_count_lines(const char *text, size_t n) {
+    size_t lines = 0;
+    const char *end = text + n;
+    while ((text = memchr(text, '\n', end - text)) != NULL) {
+        lines++;
+        text++;
+    }
+    return lines;
+}
+
+/* Loads the initial version from 'path' (a missing file gives an empty version), -1 if out of memory */
+static inline int snapshot_init(shared_snapshot_t *s, const char *path) {
+    s->cap = 4096;
+    s->buf = malloc(s->cap);
+    s->retired = NULL;
+    s->retired_bufs = NULL;
+    snapshot_t *first = malloc(sizeof(snapshot_t));
+    if (!s->buf || !first) {
+        free(s->buf);
+        free(first);
+        return -1;
+    }
+    first->version = 0;
+    first->len = 0;
+    first->retired = NULL;
+
+    FILE *input = path ? fopen(path, "r") : NULL;
+    if (input) {
+        size_t n;
+        while ((n = fread(s->buf + first->len, 1, s->cap - first->len, input)) > 0) {
+            first->len += n;
+            if (first->len == s->cap) {
+                char *bigger = realloc(s->buf, s->cap * 2);  // nobody can see buf yet
+                if (!bigger) {
+                    fclose(input);
+                    free(s->buf);
+                    free(first);
+                    s->buf = NULL;
+                    return -1;
+                }
+                s->buf = bigger;
+                s->cap *= 2;
+            }
+        }
+        fclose(input);
+    }
+    first->lines = snapshot_count_lines(s->buf, first->len);
+    first->data = s->buf;
+    atomic_init(&s->current, first);
+    return 0;
+}
+
+/* Reader side: returns a consistent version that stays valid until snapshot_destroy() */
+static inline const snapshot_t *snapshot_acquire(shared_snapshot_t *s) {
+    return atomic_load_explicit(&s->current, memory_order_acquire);
+}
+
+/* Writer side: publishes a new version with 'text' appended. Writers must be serialized. */
+static inline int snapshot_append(shared_snapshot_t *s, const char *text, size_t n) {
+    snapshot_t *old = atomic_load_explicit(&s->current, memory_order_relaxed);
+    snapshot_t *next = malloc(sizeof(snapshot_t));
+    if (!next) {
+        return -1;
+    }
+
+    if (old->len + n > s->cap) {
+        // readers may still be using the old buffer, so copy instead of realloc
+        size_t cap = s->cap;
+        while (old->len + n > cap) {
+            cap *= 2;
+        }
+        char *bigger = malloc(cap);
+        retired_buf_t *r = malloc(sizeof(retired_buf_t));
+        if (!bigger || !r) {
+            free(bigger);
+            free(r);
+            free(next);
+            return -1;
+        }
+        memcpy(bigger, s->buf, old->len);
+        r->buf = s->buf;
+        r->next = s->retired_bufs;
+        s->retired_bufs = r;
+        s->buf = bigger;
+        s->cap = cap;
+    }
+
+    // bytes past old->len are invisible to readers of the old version
+    memcpy(s->buf + old->len, text, n);
+    next->version = old->version + 1;
+    next->len = old->len + n;
+    next->lines = old->lines + snapshot_count_lines(text, n);
+    next->data = s->buf;
+    next->retired = NULL;
+    old->retired = s->retired;  // the old version is retired, not freed
+    s->retired = old;
+    atomic_store_explicit(&s->current, next, memory_order_release);
+    return 0;
+}
+
+/* Frees every version and buffer, only call once no reader can be running */
+static inline void snapshot_destroy(shared_snapshot_t *s) {
+    free(atomic_load(&s->current));
+    snapshot_t *v = s->retired;
+    while (v) {
+        snapshot_t *next = v->retired;
+        free(v);
+        v = next;
+    }
+    while (s->retired_bufs) {
+        retired_buf_t *next = s->retired_bufs->next;
+        free(s->retired_bufs->buf);
+        free(s->retired_bufs);
+        s->retired_bufs = next;
+    }
+    free(s->buf);
+    s->buf = NULL;
+    s->retired = NULL;
+}
+
+#endif  // SHARED_SNAPSHOT_H